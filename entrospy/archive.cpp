@@ -0,0 +1,666 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <streambuf>
+#include <stdexcept>
+#include <thread>
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+
+#include "archive.hpp"
+#include "output.hpp"
+#include "graph.hpp"
+
+namespace fs = boost::filesystem;
+namespace io = boost::iostreams;
+
+constexpr auto TAR_BLOCK_SIZE = 512;
+constexpr auto TAR_MAX_HEADER_DATA = 1024 * 1024;
+
+constexpr uint32_t ZIP_LOCAL_HEADER = 0x04034b50;
+constexpr uint32_t ZIP_CENTRAL_HEADER = 0x02014b50;
+constexpr uint32_t ZIP_END_OF_DIRECTORY = 0x06054b50;
+constexpr auto ZIP_LOCAL_HEADER_SIZE = 30;
+constexpr auto ZIP_CENTRAL_HEADER_SIZE = 46;
+constexpr auto ZIP_END_OF_DIRECTORY_SIZE = 22;
+
+// A boost::iostreams source yielding at most 'size' bytes of an underlying
+// stream. This lets a single archive member be scored as its own stream
+// without copying it anywhere.
+class bounded_source {
+    std::istream* m_stream;
+    uint64_t m_remaining;
+
+public:
+    using char_type = char;
+    using category = io::source_tag;
+
+    bounded_source(std::istream& stream, uint64_t size)
+        : m_stream{&stream}, m_remaining{size} {}
+
+    std::streamsize read(char* buffer, std::streamsize count) {
+        if (m_remaining == 0) {
+            return -1;
+        }
+        auto wanted = std::min<uint64_t>(count, m_remaining);
+        m_stream->read(buffer, wanted);
+        std::streamsize bytes_read = m_stream->gcount();
+        if (static_cast<uint64_t>(bytes_read) < wanted) {
+            throw std::runtime_error("truncated archive member");
+        }
+        m_remaining -= bytes_read;
+        return bytes_read;
+    }
+};
+
+template <typename T>
+T read_le(const char* data) {
+    T value = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<T>(static_cast<uint8_t>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+std::string field_string(const char* field, std::size_t length) {
+    return std::string(field, std::find(field, field + length, '\0'));
+}
+
+// Scoring a member writes its report to 'out' rather than standard out so
+// members running on different threads do not interleave their output
+struct MemberJob {
+    std::string name;
+    std::function<void(std::ostream& out)> run;
+};
+
+// Tracks which member is next to be reported, so members are printed in
+// archive order regardless of which thread scores them
+class OutputOrder {
+    std::mutex m_mutex;
+    std::condition_variable m_turn;
+    std::size_t m_head = 0;
+
+public:
+    void wait_for_turn(std::size_t index) {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_turn.wait(lock, [this, index] { return m_head == index; });
+    }
+
+    void advance() {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            ++m_head;
+        }
+        m_turn.notify_all();
+    }
+};
+
+// A stream buffer for a single member's report. Output collects in a fixed
+// MEMBER_BUFFER_SIZE buffer which is handed to standard out whenever it
+// fills, once it is this member's turn. Members which are not yet next in
+// order block when their buffer is full, bounding memory to roughly 'jobs'
+// buffers however large the members are.
+class member_output : public std::streambuf {
+    static constexpr std::size_t MEMBER_BUFFER_SIZE = 1024 * 1024;
+
+    OutputOrder& m_order;
+    std::size_t m_index;
+    std::vector<char> m_buffer;
+
+    void flush_buffer() {
+        m_order.wait_for_turn(m_index);
+        std::cout.write(pbase(), pptr() - pbase());
+        setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    }
+
+protected:
+    int_type overflow(int_type ch) override {
+        flush_buffer();
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+public:
+    member_output(OutputOrder& order, std::size_t index)
+        : m_order(order), m_index{index}, m_buffer(MEMBER_BUFFER_SIZE) {
+        setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    }
+
+    // Wait for this member's turn, emit whatever is still buffered, then
+    // hand the output over to the next member
+    void finish(const std::string& error) {
+        flush_buffer();
+        if (!error.empty()) {
+            std::cout.flush();
+            std::cerr << error << std::endl;
+        }
+        m_order.advance();
+    }
+};
+
+void run_member_jobs(const std::vector<MemberJob>& jobs,
+                     unsigned thread_count) {
+    OutputOrder order;
+    std::atomic<std::size_t> next_job{0};
+
+    // Jobs are claimed in archive order, so the member at the head of the
+    // output order is always running and never blocks on its output
+    auto worker = [&]() {
+        for (std::size_t index = next_job++; index < jobs.size();
+             index = next_job++) {
+            member_output buffer{order, index};
+            std::ostream out{&buffer};
+            std::string error;
+            try {
+                jobs[index].run(out);
+            } catch (const std::exception& e) {
+                error = "entrospy: " + jobs[index].name + ": " + e.what();
+            }
+            buffer.finish(error);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    auto worker_count =
+        std::min<std::size_t>(std::max(thread_count, 1u), jobs.size());
+    for (std::size_t i = 0; i < worker_count; ++i) {
+        workers.emplace_back(worker);
+    }
+    for (auto& thread : workers) {
+        thread.join();
+    }
+}
+
+struct ZipEntry {
+    std::string name;
+    uint16_t flags;
+    uint16_t method;
+    uint64_t compressed_size;
+    uint64_t size;
+    uint64_t header_offset;
+};
+
+std::vector<ZipEntry> read_zip_directory(std::istream& in,
+                                         uint64_t file_size) {
+    if (file_size < ZIP_END_OF_DIRECTORY_SIZE) {
+        throw std::runtime_error("truncated zip archive");
+    }
+
+    // The end of central directory record is only followed by a comment of
+    // up to 64K, so search backwards for its signature
+    auto tail_size =
+        std::min<uint64_t>(file_size, ZIP_END_OF_DIRECTORY_SIZE + 0xffff);
+    std::vector<char> tail(tail_size);
+    in.seekg(file_size - tail_size);
+    in.read(tail.data(), tail_size);
+    if (!in) {
+        throw std::runtime_error("unable to read zip archive");
+    }
+
+    const char* eocd = nullptr;
+    for (auto i = tail_size - ZIP_END_OF_DIRECTORY_SIZE + 1; i-- > 0;) {
+        if (read_le<uint32_t>(&tail[i]) == ZIP_END_OF_DIRECTORY) {
+            eocd = &tail[i];
+            break;
+        }
+    }
+    if (eocd == nullptr) {
+        throw std::runtime_error("missing zip central directory");
+    }
+
+    auto entry_count = read_le<uint16_t>(eocd + 10);
+    auto directory_size = read_le<uint32_t>(eocd + 12);
+    auto directory_offset = read_le<uint32_t>(eocd + 16);
+    if (entry_count == 0xffff || directory_offset == 0xffffffff) {
+        throw std::runtime_error("zip64 archives are not supported");
+    }
+    if (uint64_t{directory_offset} + directory_size > file_size) {
+        throw std::runtime_error("corrupt zip central directory");
+    }
+
+    std::vector<char> directory(directory_size);
+    in.seekg(directory_offset);
+    in.read(directory.data(), directory_size);
+    if (!in) {
+        throw std::runtime_error("truncated zip central directory");
+    }
+
+    std::vector<ZipEntry> entries;
+    std::size_t position = 0;
+    for (auto i = 0; i < entry_count; ++i) {
+        if (position + ZIP_CENTRAL_HEADER_SIZE > directory.size() ||
+            read_le<uint32_t>(&directory[position]) != ZIP_CENTRAL_HEADER) {
+            throw std::runtime_error("corrupt zip central directory");
+        }
+
+        const char* record = &directory[position];
+        ZipEntry entry;
+        entry.flags = read_le<uint16_t>(record + 8);
+        entry.method = read_le<uint16_t>(record + 10);
+        entry.compressed_size = read_le<uint32_t>(record + 20);
+        entry.size = read_le<uint32_t>(record + 24);
+        entry.header_offset = read_le<uint32_t>(record + 42);
+        auto name_length = read_le<uint16_t>(record + 28);
+        auto extra_length = read_le<uint16_t>(record + 30);
+        auto comment_length = read_le<uint16_t>(record + 32);
+
+        if (entry.compressed_size == 0xffffffff || entry.size == 0xffffffff ||
+            entry.header_offset == 0xffffffff) {
+            throw std::runtime_error("zip64 archives are not supported");
+        }
+        if (position + ZIP_CENTRAL_HEADER_SIZE + name_length >
+            directory.size()) {
+            throw std::runtime_error("corrupt zip central directory");
+        }
+
+        entry.name.assign(record + ZIP_CENTRAL_HEADER_SIZE, name_length);
+        position += ZIP_CENTRAL_HEADER_SIZE + name_length + extra_length +
+                    comment_length;
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+void shannon_zip_member(const std::string& path, uint64_t file_size,
+                        const ZipEntry& entry, const std::string& name,
+                        uint64_t block_size, const PrintingPolicy& policy,
+                        DataFormat format, EntropyGraph& graph,
+                        std::ostream& out) {
+    // Each member gets its own handle so members can be read concurrently
+    std::ifstream file{path, std::ifstream::binary};
+    if (entry.header_offset + ZIP_LOCAL_HEADER_SIZE > file_size) {
+        throw std::runtime_error("corrupt zip local header");
+    }
+    std::array<char, ZIP_LOCAL_HEADER_SIZE> header;
+    file.seekg(entry.header_offset);
+    file.read(header.data(), header.size());
+    if (!file || read_le<uint32_t>(header.data()) != ZIP_LOCAL_HEADER) {
+        throw std::runtime_error("corrupt zip local header");
+    }
+    auto name_length = read_le<uint16_t>(&header[26]);
+    auto extra_length = read_le<uint16_t>(&header[28]);
+    auto data_offset = entry.header_offset + ZIP_LOCAL_HEADER_SIZE +
+                       name_length + extra_length;
+    if (data_offset + entry.compressed_size > file_size) {
+        throw std::runtime_error("corrupt zip local header");
+    }
+    file.seekg(data_offset);
+
+    io::filtering_istream member;
+
+    auto size = entry.size;
+    if (entry.flags & 0x1) {
+        // Encrypted members cannot be decompressed, but the raw encrypted
+        // bytes are exactly what we want to score
+        size = entry.compressed_size;
+    } else if (entry.method == 8) {
+        io::zlib_params params;
+        params.noheader = true; // zip members are raw deflate streams
+        member.push(io::zlib_decompressor{params});
+    } else if (entry.method != 0) {
+        throw std::runtime_error("unsupported compression method " +
+                                 std::to_string(entry.method));
+    }
+    member.push(bounded_source{file, entry.compressed_size});
+    member.exceptions(std::ios_base::badbit);
+
+    shannon_stream(member, name, size, block_size, policy, format, graph,
+                   out);
+}
+
+void shannon_zip(const std::string& path, uint64_t block_size,
+                 const PrintingPolicy& policy, DataFormat format,
+                 unsigned jobs, EntropyGraph& graph) {
+    std::ifstream file{path, std::ifstream::binary};
+    auto file_size = fs::file_size(path);
+    auto entries = read_zip_directory(file, file_size);
+
+    std::vector<MemberJob> member_jobs;
+    for (const auto& entry : entries) {
+        if (!entry.name.empty() && entry.name.back() == '/') {
+            continue; // directory
+        }
+
+        auto name = path + ":" + entry.name;
+        member_jobs.push_back(
+            {name, [=, &policy, &graph](std::ostream& out) {
+                 shannon_zip_member(path, file_size, entry, name, block_size,
+                                    policy, format, graph, out);
+             }});
+    }
+    run_member_jobs(member_jobs, jobs);
+}
+
+struct TarEntry {
+    std::string name;
+    uint64_t size;
+    uint64_t offset;
+};
+
+using tar_visitor_t =
+    std::function<void(const TarEntry& entry, std::istream& data)>;
+
+uint64_t parse_tar_number(const char* field, std::size_t length) {
+    // GNU tar stores values too large for octal in base-256, flagged by
+    // the high bit of the first byte
+    if (field[0] & 0x80) {
+        uint64_t value = field[0] & 0x7f;
+        for (std::size_t i = 1; i < length; ++i) {
+            value = (value << 8) | static_cast<uint8_t>(field[i]);
+        }
+        return value;
+    }
+
+    uint64_t value = 0;
+    for (std::size_t i = 0; i < length; ++i) {
+        auto digit = field[i];
+        if (digit == ' ' && value == 0) {
+            continue;
+        } else if (digit < '0' || digit > '7') {
+            break;
+        }
+        value = value * 8 + (digit - '0');
+    }
+    return value;
+}
+
+// Extract the 'path' record from a pax extended header. Each record has the
+// form "<length> <key>=<value>\n" where length counts the whole record.
+std::string pax_path(const std::string& records) {
+    std::size_t position = 0;
+    while (position < records.size()) {
+        auto space = records.find(' ', position);
+        if (space == std::string::npos || space == position) {
+            throw std::runtime_error("corrupt tar extended header");
+        }
+
+        std::size_t length = 0;
+        for (auto i = position; i < space; ++i) {
+            if (records[i] < '0' || records[i] > '9' ||
+                length > records.size()) {
+                throw std::runtime_error("corrupt tar extended header");
+            }
+            length = length * 10 + (records[i] - '0');
+        }
+        if (space + 1 >= position + length ||
+            position + length > records.size()) {
+            throw std::runtime_error("corrupt tar extended header");
+        }
+
+        auto record = records.substr(space + 1, position + length - space - 2);
+        auto equals = record.find('=');
+        if (equals != std::string::npos && record.substr(0, equals) == "path") {
+            return record.substr(equals + 1);
+        }
+        position += length;
+    }
+    return "";
+}
+
+bool is_zero_block(const std::array<char, TAR_BLOCK_SIZE>& block) {
+    return std::all_of(block.begin(), block.end(),
+                       [](char c) { return c == '\0'; });
+}
+
+uint64_t tar_padded_size(uint64_t size) {
+    return (size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+}
+
+// Move 'count' bytes further through a tar stream, seeking if possible
+void skip_tar_data(std::istream& in, bool seekable, uint64_t& offset,
+                   uint64_t count) {
+    offset += count;
+    if (seekable) {
+        in.seekg(offset);
+    } else {
+        in.ignore(count);
+    }
+}
+
+// Read headers from a tar stream until the next regular file, leaving the
+// stream at the start of its contents. Extended headers are applied to the
+// entry and other member types are skipped. Returns false at the two zero
+// blocks which end the archive; running out of data first is an error.
+bool next_tar_entry(std::istream& in, bool seekable, uint64_t& offset,
+                    TarEntry& entry) {
+    std::array<char, TAR_BLOCK_SIZE> header;
+    std::string long_name;
+
+    while (true) {
+        in.read(header.data(), header.size());
+        if (in.gcount() < TAR_BLOCK_SIZE) {
+            throw std::runtime_error("truncated tar archive");
+        }
+        offset += TAR_BLOCK_SIZE;
+
+        if (is_zero_block(header)) {
+            in.read(header.data(), header.size());
+            if (in.gcount() < TAR_BLOCK_SIZE || !is_zero_block(header)) {
+                throw std::runtime_error("truncated tar archive");
+            }
+            return false;
+        }
+
+        entry.name = field_string(&header[0], 100);
+        if (field_string(&header[257], 5) == "ustar") {
+            auto prefix = field_string(&header[345], 155);
+            if (!prefix.empty()) {
+                entry.name = prefix + "/" + entry.name;
+            }
+        }
+        entry.size = parse_tar_number(&header[124], 12);
+        entry.offset = offset;
+        auto type = header[156];
+
+        // GNU long names and pax extended headers carry the name of the
+        // member which follows them
+        if (type == 'L' || type == 'x') {
+            if (entry.size > TAR_MAX_HEADER_DATA) {
+                throw std::runtime_error("corrupt tar extended header");
+            }
+            std::string data(entry.size, '\0');
+            in.read(&data[0], entry.size);
+            if (static_cast<uint64_t>(in.gcount()) < entry.size) {
+                throw std::runtime_error("truncated tar archive");
+            }
+            offset += entry.size;
+            skip_tar_data(in, seekable, offset,
+                          tar_padded_size(entry.size) - entry.size);
+
+            auto name = (type == 'L') ? field_string(data.data(), data.size())
+                                      : pax_path(data);
+            if (!name.empty()) {
+                long_name = name;
+            }
+            continue;
+        }
+
+        if (!long_name.empty()) {
+            entry.name = long_name;
+            long_name.clear();
+        }
+
+        if (type == '0' || type == '\0' || type == '7') {
+            return true;
+        }
+        skip_tar_data(in, seekable, offset, tar_padded_size(entry.size));
+    }
+}
+
+// Walk the regular files of a non-seekable tar stream in order, calling
+// 'visit' with a stream of each one's contents
+void walk_tar(std::istream& in, const tar_visitor_t& visit) {
+    uint64_t offset = 0;
+    TarEntry entry;
+    while (next_tar_entry(in, false, offset, entry)) {
+        {
+            io::filtering_istream data;
+            data.push(bounded_source{in, entry.size});
+            data.exceptions(std::ios_base::badbit);
+            visit(entry, data);
+
+            // Drain whatever the visitor left unread
+            data.ignore(std::numeric_limits<std::streamsize>::max());
+        }
+        offset += entry.size;
+        skip_tar_data(in, false, offset,
+                      tar_padded_size(entry.size) - entry.size);
+    }
+}
+
+void shannon_tar(const std::string& path, uint64_t block_size,
+                 const PrintingPolicy& policy, DataFormat format,
+                 unsigned jobs, EntropyGraph& graph) {
+    std::ifstream file{path, std::ifstream::binary};
+
+    // Score the members found before any error in the listing, then report
+    // the error
+    std::vector<MemberJob> member_jobs;
+    std::exception_ptr error;
+    try {
+        uint64_t offset = 0;
+        TarEntry entry;
+        while (next_tar_entry(file, true, offset, entry)) {
+            auto name = path + ":" + entry.name;
+            member_jobs.push_back(
+                {name, [=, &policy, &graph](std::ostream& out) {
+                     std::ifstream member_file{path, std::ifstream::binary};
+                     member_file.seekg(entry.offset);
+
+                     io::filtering_istream member;
+                     member.push(bounded_source{member_file, entry.size});
+                     member.exceptions(std::ios_base::badbit);
+                     shannon_stream(member, name, entry.size, block_size,
+                                    policy, format, graph, out);
+                 }});
+            skip_tar_data(file, true, offset, tar_padded_size(entry.size));
+        }
+    } catch (const std::exception&) {
+        error = std::current_exception();
+    }
+
+    run_member_jobs(member_jobs, jobs);
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Members of a compressed tarball share a single deflate stream, so unlike
+// zip and plain tar members they can only be read in order
+void shannon_tar_gzip(const std::string& path, uint64_t block_size,
+                      const PrintingPolicy& policy, DataFormat format,
+                      EntropyGraph& graph) {
+    std::ifstream file{path, std::ifstream::binary};
+    io::filtering_istream stream;
+    stream.push(io::gzip_decompressor{});
+    stream.push(file);
+    stream.exceptions(std::ios_base::badbit);
+
+    walk_tar(stream, [&](const TarEntry& entry, std::istream& data) {
+        shannon_stream(data, path + ":" + entry.name, entry.size, block_size,
+                       policy, format, graph, std::cout);
+    });
+}
+
+void shannon_gzip(const std::string& path, uint64_t block_size,
+                  const PrintingPolicy& policy, DataFormat format,
+                  EntropyGraph& graph) {
+    std::ifstream file{path, std::ifstream::binary};
+
+    // The gzip trailer records the uncompressed size modulo 2^32. Members of
+    // 4G or more are streamed before their real size is known, so they get
+    // an address width based on this truncated size.
+    std::array<char, 4> trailer{};
+    file.seekg(-static_cast<std::streamoff>(trailer.size()),
+               std::ios_base::end);
+    file.read(trailer.data(), trailer.size());
+    auto size = read_le<uint32_t>(trailer.data());
+    file.clear();
+    file.seekg(0);
+
+    fs::path member{path};
+    member = member.filename();
+    if (boost::algorithm::iequals(member.extension().string(), ".gz")) {
+        member = member.stem();
+    }
+
+    io::filtering_istream stream;
+    stream.push(io::gzip_decompressor{});
+    stream.push(file);
+    stream.exceptions(std::ios_base::badbit);
+    shannon_stream(stream, path + ":" + member.string(), size, block_size,
+                   policy, format, graph, std::cout);
+}
+
+bool is_tar_header(const char* header, std::streamsize size) {
+    return size == TAR_BLOCK_SIZE && field_string(header + 257, 5) == "ustar";
+}
+
+ArchiveType archive_type(const std::string& path) {
+    std::ifstream file{path, std::ifstream::binary};
+    std::array<char, TAR_BLOCK_SIZE> header{};
+    file.read(header.data(), header.size());
+    auto bytes_read = file.gcount();
+
+    if (bytes_read >= 4) {
+        auto magic = read_le<uint32_t>(header.data());
+        if (magic == ZIP_LOCAL_HEADER || magic == ZIP_END_OF_DIRECTORY) {
+            return ArchiveType::ZIP;
+        }
+    }
+    if (bytes_read >= 2 && static_cast<uint8_t>(header[0]) == 0x1f &&
+        static_cast<uint8_t>(header[1]) == 0x8b) {
+        // Look inside the compressed stream to tell a tarball from a
+        // single compressed file
+        file.clear();
+        file.seekg(0);
+        io::filtering_istream stream;
+        stream.push(io::gzip_decompressor{});
+        stream.push(file);
+        stream.read(header.data(), header.size());
+        if (is_tar_header(header.data(), stream.gcount())) {
+            return ArchiveType::TAR_GZIP;
+        }
+        return ArchiveType::GZIP;
+    }
+    if (is_tar_header(header.data(), bytes_read)) {
+        return ArchiveType::TAR;
+    }
+    return ArchiveType::NONE;
+}
+
+void shannon_archive(const std::string& path, ArchiveType type,
+                     uint64_t block_size, const PrintingPolicy& policy,
+                     DataFormat format, unsigned jobs, EntropyGraph& graph) {
+    try {
+        switch (type) {
+        case ArchiveType::ZIP:
+            shannon_zip(path, block_size, policy, format, jobs, graph);
+            break;
+        case ArchiveType::TAR:
+            shannon_tar(path, block_size, policy, format, jobs, graph);
+            break;
+        case ArchiveType::TAR_GZIP:
+            shannon_tar_gzip(path, block_size, policy, format, graph);
+            break;
+        case ArchiveType::GZIP:
+            shannon_gzip(path, block_size, policy, format, graph);
+            break;
+        case ArchiveType::NONE:
+            shannon_file(path, block_size, policy, format, graph);
+            break;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "entrospy: " << path << ": " << e.what() << std::endl;
+    }
+}
@@ -2,8 +2,10 @@
 #include <ios>
 #include <cmath>
 #include <cstdio>
+#include <thread>
 #include <boost/filesystem.hpp>
 
+#include "archive.hpp"
 #include "shannon.hpp"
 #include "output.hpp"
 #include "graph.hpp"
@@ -48,6 +50,7 @@ int main(int argc, char** argv) {
 
     PrintingPolicy policy;
     DataFormat format;
+    unsigned jobs;
     std::vector<std::string> paths;
 
     desc.add_options()                    //
@@ -78,6 +81,13 @@ int main(int argc, char** argv) {
          "Input format: 'data','text' or 'base64'") //
         ("graph,g",
          "Output a gnuplot script to standard out") //
+        ("archives,x",
+         "Score each member of .gz, .tar, .tar.gz and .zip archives rather"
+         " than the archive itself. Members are reported as"
+         " 'archive:member'") //
+        ("jobs,j", po::value<unsigned>(&jobs)->default_value(
+                       std::max(1u, std::thread::hardware_concurrency())),
+         "Number of threads used to score archive members") //
         ("recursive,r",
          "Run directories in PATH recursively"); //
 
@@ -131,6 +141,19 @@ int main(int argc, char** argv) {
                  boost::algorithm::join(paths, ", ") % block_size;
 
     EntropyGraph graph{boost::str(title), block_size, policy};
+    auto scan = [&](const std::string& path) {
+        // Sniffing consumes input, so only regular files can be archives
+        if (vm.count("archives") && fs::is_regular_file(path)) {
+            auto type = archive_type(path);
+            if (type != ArchiveType::NONE) {
+                shannon_archive(path, type, block_size, policy, format, jobs,
+                                graph);
+                return;
+            }
+        }
+        shannon_file(path, block_size, policy, format, graph);
+    };
+
     for (const auto& path : paths) {
         if (fs::is_directory(path)) {
             if (!vm.count("recursive")) {
@@ -147,13 +170,12 @@ int main(int argc, char** argv) {
                         continue;
                     }
                     if (!is_hidden(iter->path()) || vm.count("all")) {
-                        shannon_file(iter->path().string(), block_size, policy,
-                                     format, graph);
+                        scan(iter->path().string());
                     }
                 }
             }
         } else {
-            shannon_file(path, block_size, policy, format, graph);
+            scan(path);
         }
     }
 
@@ -1,15 +1,25 @@
-#include <boost/filesystem.hpp>
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 
 #include "graph.hpp"
 
 EntropyGraph::EntropyGraph(const std::string& title, uint64_t block_size,
                            const PrintingPolicy& policy)
-    : m_title{title}, m_block_size{block_size}, m_policy{policy}, m_scores{} {}
+    : m_title{title},
+      m_block_size{block_size},
+      m_policy{policy},
+      m_scores{},
+      m_sizes{} {}
 
-void EntropyGraph::insert(const std::string& path, std::streampos position,
-                          double score) {
+void EntropyGraph::insert(const std::string& path, uint64_t size,
+                          std::streampos position, double score) {
+    // Archive members are scored concurrently, so guard the maps
+    std::lock_guard<std::mutex> lock{m_mutex};
     m_scores[path].emplace_back(position, score);
+    // 'size' may be an estimate (e.g. the gzip trailer's size modulo 2^32),
+    // so never let the plot range clip a block we have actually scored
+    auto& max_size = m_sizes[path];
+    max_size = std::max<uint64_t>({max_size, size, uint64_t(position)});
 }
 
 std::ostream& operator<<(std::ostream& out, const EntropyGraph& graph) {
@@ -28,7 +38,7 @@ std::ostream& operator<<(std::ostream& out, const EntropyGraph& graph) {
     uint64_t max_file_size = 0;
     for (const auto& pv : graph.m_scores) {
         const auto& path = pv.first;
-        auto file_size = boost::filesystem::file_size(path);
+        auto file_size = graph.m_sizes.at(path);
         if (file_size > max_file_size) {
             max_file_size = file_size;
         }
@@ -0,0 +1,24 @@
+#ifndef ENTROSPY_ARCHIVE
+#define ENTROSPY_ARCHIVE
+
+#include <string>
+
+#include "shannon.hpp"
+
+class PrintingPolicy;
+class EntropyGraph;
+
+enum class ArchiveType { NONE, GZIP, TAR, TAR_GZIP, ZIP };
+
+// Determine the container format of 'path' from its magic bytes, looking
+// inside gzip streams for a tar header
+ArchiveType archive_type(const std::string& path);
+
+// Score each member of the archive at 'path' individually, reporting them
+// as 'path:member'. Members that can be read independently are scored on up
+// to 'jobs' threads.
+void shannon_archive(const std::string& path, ArchiveType type,
+                     uint64_t block_size, const PrintingPolicy& policy,
+                     DataFormat format, unsigned jobs, EntropyGraph& graph);
+
+#endif
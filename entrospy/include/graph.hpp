@@ -2,6 +2,7 @@
 #define ENTROSPY_GRAPH
 
 #include <map>
+#include <mutex>
 
 #include "output.hpp"
 
@@ -12,12 +13,14 @@ class EntropyGraph {
 
     using scores_t = std::vector<std::pair<std::streampos, double>>;
     std::map<std::string, scores_t> m_scores;
+    std::map<std::string, uint64_t> m_sizes;
+    std::mutex m_mutex;
 
 public:
     EntropyGraph(const std::string& title, uint64_t block_size,
                  const PrintingPolicy& policy);
-    void insert(const std::string& filename, std::streampos position,
-                double scores);
+    void insert(const std::string& filename, uint64_t size,
+                std::streampos position, double scores);
 
     friend std::ostream& operator<<(std::ostream&, const EntropyGraph&);
 };
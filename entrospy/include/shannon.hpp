@@ -32,6 +32,10 @@ inline std::istream& operator>>(std::istream& in, DataFormat& format) {
 }
 
 class EntropyGraph;
+void shannon_stream(std::istream& stream, const std::string& name,
+                    uint64_t size, uint64_t block_size,
+                    const PrintingPolicy& policy, DataFormat format,
+                    EntropyGraph&, std::ostream& out);
 void shannon_file(const std::string& path, uint64_t block_size,
                   const PrintingPolicy& policy, DataFormat format,
                   EntropyGraph&);
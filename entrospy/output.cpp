@@ -22,6 +22,9 @@ std::istream& operator>>(std::istream& in, AddressFormat& format) {
 }
 
 uint8_t address_width(AddressFormat format, uint64_t address) {
+    if (address == 0) {
+        return 1;
+    }
     switch (format) {
     case AddressFormat::DECIMAL:
         return std::ceil(std::log10(address));
@@ -31,27 +34,27 @@ uint8_t address_width(AddressFormat format, uint64_t address) {
     assert(false && "Unknown address format");
 }
 
-void print_score(const std::string& path, uint64_t address,
-                 uint64_t address_width, double score,
+void print_score(std::ostream& out, const std::string& path,
+                 uint64_t address, uint64_t address_width, double score,
                  const PrintingPolicy& policy) {
-    auto out = boost::format("%1%: %2%: score: %3%");
-    out % path;
-    out % boost::io::group(address_format_modifier(policy.addr_format),
-                           std::setw(address_width), std::setfill('0'),
-                           address);
-    out % score;
-    std::cout << out;
+    auto line = boost::format("%1%: %2%: score: %3%");
+    line % path;
+    line % boost::io::group(address_format_modifier(policy.addr_format),
+                            std::setw(address_width), std::setfill('0'),
+                            address);
+    line % score;
+    out << line;
     if (policy.categorize) {
-        std::cout << ": category: " << categorize(score, policy);
+        out << ": category: " << categorize(score, policy);
     }
-    std::cout << "\n";
+    out << "\n";
 }
 
-void print_score(const std::string& path, double score,
-                 const PrintingPolicy& policy) {
-    std::cout << path << ": score: " << score;
+void print_score(std::ostream& out, const std::string& path,
+                 double score, const PrintingPolicy& policy) {
+    out << path << ": score: " << score;
     if (policy.categorize) {
-        std::cout << ": category: " << categorize(score, policy);
+        out << ": category: " << categorize(score, policy);
     }
-    std::cout << "\n";
+    out << "\n";
 }
@@ -83,6 +83,8 @@ class shannon_iterator
     std::vector<uint8_t> m_block;
     bool m_clear_stats;
     counter_t m_counter;
+    uint64_t m_position;
+    uint64_t m_bytes_read;
 
 public:
     shannon_iterator() = default;
@@ -93,7 +95,9 @@ public:
           m_block_size{block_size},
           m_block(block_size),
           m_clear_stats{clear_stats},
-          m_counter{} {
+          m_counter{},
+          m_position{0},
+          m_bytes_read{0} {
         this->increment(); // Get meaningful data in the buffer
     }
     void increment() {
@@ -105,6 +109,11 @@ public:
             std::streamsize bytes_read = m_stream->gcount();
             m_block.resize(bytes_read);
 
+            // Track offsets ourselves rather than using tellg, as
+            // decompressing streams cannot report their position
+            m_position = m_bytes_read;
+            m_bytes_read += bytes_read;
+
             if (m_clear_stats) {
                 m_counter.fill(0);
             }
@@ -123,30 +132,20 @@ public:
         if (m_clear_stats) {
             return shannon_score(m_counter, m_block_size, m_format);
         } else {
-            // If we have reached eof, seek to end and clear so we can
-            // use tellg to get the total bytes read
-            if (m_stream->fail()) {
-                m_stream->seekg(0, std::ios_base::end);
-                m_stream->clear();
-            }
-            auto bytes_read = m_stream->tellg();
-            return shannon_score(m_counter, bytes_read, m_format);
+            return shannon_score(m_counter, m_bytes_read, m_format);
         }
     }
 
     const std::vector<uint8_t>& block() const { return m_block; }
-    std::streampos position() {
-        return m_stream->tellg() - std::streamoff(m_block_size);
-    }
+    std::streampos position() { return m_position; }
 };
 
-void shannon_file(const std::string& path, uint64_t block_size,
-                  const PrintingPolicy& policy, DataFormat format,
-                  EntropyGraph& graph) {
-    std::ifstream file_stream{path, std::ifstream::binary};
-
+void shannon_stream(std::istream& stream, const std::string& name,
+                    uint64_t size, uint64_t block_size,
+                    const PrintingPolicy& policy, DataFormat format,
+                    EntropyGraph& graph, std::ostream& out) {
     if (!block_size) {
-        shannon_iterator iter{file_stream, DEFAULT_BLOCK_SIZE, format, false};
+        shannon_iterator iter{stream, DEFAULT_BLOCK_SIZE, format, false};
         shannon_iterator end{};
         for (; iter != end; ++iter) {
         }
@@ -156,12 +155,11 @@ void shannon_file(const std::string& path, uint64_t block_size,
             return;
         }
 
-        print_score(path, score, policy);
+        print_score(out, name, score, policy);
     } else {
-        shannon_iterator iter{file_stream, block_size, format};
+        shannon_iterator iter{stream, block_size, format};
         shannon_iterator end{};
-        auto file_size = fs::file_size(path);
-        auto addr_width = address_width(policy.addr_format, file_size);
+        auto addr_width = address_width(policy.addr_format, size);
 
         for (; iter != end; ++iter) {
             auto score = *iter;
@@ -171,14 +169,24 @@ void shannon_file(const std::string& path, uint64_t block_size,
             }
 
             if (policy.print_graph) {
-                graph.insert(path, iter.position(), score);
+                graph.insert(name, size, iter.position(), score);
                 continue;
             }
-            print_score(path, iter.position(), addr_width, score, policy);
+            print_score(out, name, iter.position(), addr_width, score, policy);
             if (policy.print_blocks) {
-                print_block_bytes(iter.block().begin(), iter.block().end(),
-                                  iter.position(), addr_width, policy);
+                print_block_bytes(out, iter.block().begin(),
+                                  iter.block().end(), iter.position(),
+                                  addr_width, policy);
             }
         }
     }
 }
+
+void shannon_file(const std::string& path, uint64_t block_size,
+                  const PrintingPolicy& policy, DataFormat format,
+                  EntropyGraph& graph) {
+    std::ifstream file_stream{path, std::ifstream::binary};
+    uint64_t file_size = block_size ? fs::file_size(path) : 0;
+    shannon_stream(file_stream, path, file_size, block_size, policy, format,
+                   graph, std::cout);
+}